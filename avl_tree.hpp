@@ -7,6 +7,20 @@
 #include <thread>
 #include <tuple>
 #include <stack>
+#include <limits>
+#include <new>
+#include <iterator>
+#include <cstddef>
+#include <type_traits>
+#include <memory>
+#include <algorithm>
+#include <variant>
+
+#if defined(__GNUC__)
+    #define GB_PREFETCH(address) __builtin_prefetch(address)
+#else
+    #define GB_PREFETCH(address)
+#endif
 
 namespace AVL{
     using int_t = int32_t;
@@ -22,6 +36,15 @@ namespace AVL{
     template<typename T>
     using stack_t = std::stack<T>;
 
+    // an AVL tree of n nodes is lower than 1.4405 * log2(n + 2), 96 covers any size_t count
+    constexpr size_t max_height = 96;
+
+    constexpr size_t ceil_pow2(size_t n){
+        size_t result = 1;
+        while(result < n) result <<= 1;
+        return result;
+    }
+
     enum class iterator_dir: uint_t{
         forward = 0,
         reverse = 1,
@@ -32,6 +55,7 @@ namespace AVL{
         child_mask = 8,                        // 00001000
         //  left_child_mask == child_mask << 0 == 00001000
         // right_child_mask == child_mask << 1 == 00010000
+        arena_mask = 32,                       // 00100000 children_ points into a compaction chunk
         default_mask = 2,                      // 00000010
     };
 
@@ -47,10 +71,13 @@ namespace AVL{
         std::array<ipair, 5>{ipair(SC,SC), ipair( 1,-2), ipair( 1,-1), ipair( 0, 0), ipair(-1, 0),}, // 2
     };
 
-    const ipair& get_updated_balance_factors(int_t parent_bf, int_t child_bf){
+    constexpr const ipair& get_updated_balance_factors(int_t parent_bf, int_t child_bf){
         return balance_factor_table[parent_bf + 2][child_bf + 2];
     }
 
+    template<typename T, size_t threshold>
+    class HybridTree;
+
     template<typename T>
     class Tree{
         private:
@@ -80,12 +107,18 @@ namespace AVL{
                 void set_child(direction_t dir){   this->bits_ |=   static_cast<int8_t>(mask_t::child_mask) << dir; }
                 void reset_child(direction_t dir){ this->bits_ &= ~(static_cast<int8_t>(mask_t::child_mask) << dir); }
 
+                bool in_arena() const { return static_cast<int8_t>(mask_t::arena_mask) & this->bits_; }
+                void set_in_arena(){   this->bits_ |=   static_cast<int8_t>(mask_t::arena_mask); }
+                void reset_in_arena(){ this->bits_ &= ~static_cast<int8_t>(mask_t::arena_mask); }
+
                 const T& value() const { return this->value_; }
                 T& value(){ return this->value_; }
 
                 template<typename U>
                 void add_leaf(U&& value, direction_t dir);
                 void remove_leaf(direction_t dir);
+                void allocate_children();
+                void release_children();
 
                 Node& operator=(Node&& that);
 
@@ -231,6 +264,52 @@ namespace AVL{
             Node root_;
             size_t size_;
 
+            // Pairs relocated by compact()/compact_step() live in chunks aligned to chunk_bytes, so a pair finds
+            // its chunk's header by masking its own address. A chunk goes away with the last pair released from it.
+            struct chunk_t{
+                size_t references;  // pairs in use, plus one until the pass in progress has scanned the chunk
+                chunk_t* next;      // next chunk filled by the same pass
+                bool in_pass;
+            };
+            static constexpr size_t pairs_offset = (sizeof(chunk_t) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+            static constexpr size_t chunk_bytes = ceil_pow2(std::max<size_t>(1 << 14, pairs_offset + 2 * sizeof(Node) * 16));
+            static constexpr size_t chunk_pairs = (chunk_bytes - pairs_offset) / (2 * sizeof(Node));
+
+            // Breadth-first pass, Cheney style: the pairs relocated so far are the queue, `scan` trails `fill`.
+            // Writes in between don't stop it, pairs they create outside the pass are picked up by the next one.
+            // Chunks leave the pass as soon as `scan` is done with them, only scan_chunk..fill_chunk belong to it.
+            struct compaction_t{
+                chunk_t* scan_chunk;
+                size_t scan;
+                chunk_t* fill_chunk;
+                size_t fill;
+            };
+            std::unique_ptr<compaction_t> compaction_;
+
+            static chunk_t* allocate_chunk();
+            static chunk_t* chunk_of(const Node* pair){
+                return reinterpret_cast<chunk_t*>(reinterpret_cast<uintptr_t>(pair) & ~static_cast<uintptr_t>(chunk_bytes - 1));
+            }
+            static Node* pairs_of(chunk_t* chunk){ return reinterpret_cast<Node*>(reinterpret_cast<uint8_t*>(chunk) + pairs_offset); }
+            static void release_chunk(chunk_t* chunk);
+            static void release_pair(Node* pair);
+            void begin_compaction();
+            void end_compaction();
+            void relocate_children(Node& node);
+
+            void release_nodes();
+
+            template<direction_t first, typename node_t, typename F>
+            void for_each_priv(F& f) const;
+
+            // ascending visit handing out T&, for an owner that moves the values out and drops the tree
+            template<typename, size_t>
+            friend class HybridTree;
+            template<typename F>
+            void drain(F&& f){ this->for_each_priv<left, Node>(f); }
+
+            int_t valid_priv(const Node& node, const T*& previous, size_t& count) const;
+
             template<typename U>
             void add_priv(U&& X);
 
@@ -246,6 +325,9 @@ namespace AVL{
             bool empty() const { return size_ == 0; }
             size_t size() const { return this->size_; }
             size_t height() const;
+            void clear();
+            // Checks ordering, balance factors against real subtree heights, child and arena bits against children_ and size_.
+            bool valid() const;
 
             void add(const T& X){ this->add_priv(X); }
             void add(T&& X){ this->add_priv(std::move(X)); }
@@ -260,6 +342,19 @@ namespace AVL{
                 return remove(this->find(X));
             }
 
+            // Moves every sibling pair into fresh contiguous chunks in breadth-first order.
+            // Structure and balance bits are left untouched, iterators and positions are invalidated.
+            void compact();
+            // Scans at most `budget` pairs of the current compaction pass (starting one if needed)
+            // and returns true once the pass is complete. add/remove may be called in between.
+            bool compact_step(size_t budget);
+
+            // In-order (ascending / descending) visit of every value without going through iterators.
+            template<typename F>
+            void for_each(F&& f) const { this->for_each_priv<left, const Node>(f); }
+            template<typename F>
+            void for_each_reverse(F&& f) const { this->for_each_priv<right, const Node>(f); }
+
             position_t<Node> find(const T& X){ return find_priv<Node>(X); }
             position_t<const Node> find(const T& X) const { return find_priv<const Node>(X); }
             position_t<Node> find_farthest(direction_t dir){ return find_farthest<Node>(); }
@@ -283,7 +378,7 @@ namespace AVL{
             Tree(const Tree& that){
                 *this = that;
             }
-            Tree(Tree&& that): root_(std::move(that.root_)), size_(that.size_){
+            Tree(Tree&& that): root_(std::move(that.root_)), size_(that.size_), compaction_(std::move(that.compaction_)){
                 that.size_ = 0;
             }
             Tree(std::initializer_list<T> list): size_(0){
@@ -300,10 +395,7 @@ namespace AVL{
                 }
             }
             ~Tree(){
-                for(auto ri = this->rbegin(); ri != this->rend(); ++ri){
-                    ri.current_node().remove_leaf(left);
-                    ri.current_node().remove_leaf(right);
-                }
+                this->release_nodes();
             }
     };
 
@@ -311,7 +403,7 @@ template<typename T>
 template<typename U>
 void Tree<T>::Node::add_leaf(U&& value, direction_t dir){
     if(this->children_ == nullptr){
-        this->children_ = reinterpret_cast<Node*>(new uint8_t[sizeof(Node) * 2]);
+        this->allocate_children();
     }
     if(!has_child(dir)){
         new (this->children_ + dir) Node (std::forward<U>(value));
@@ -329,11 +421,27 @@ void Tree<T>::Node::remove_leaf(direction_t dir){
         shift_balance_factor(-weight(dir));
     }
     if(!has_any_children() && children_ != nullptr){
-        delete[] reinterpret_cast<uint8_t*>(children_);
-        children_ = nullptr;
+        this->release_children();
     }
 }
 
+template<typename T>
+void Tree<T>::Node::allocate_children(){
+    this->children_ = reinterpret_cast<Node*>(new uint8_t[sizeof(Node) * 2]);
+    this->reset_in_arena();
+}
+
+template<typename T>
+void Tree<T>::Node::release_children(){
+    if(this->in_arena()){
+        Tree::release_pair(this->children_);
+    } else {
+        delete[] reinterpret_cast<uint8_t*>(this->children_);
+    }
+    this->children_ = nullptr;
+    this->reset_in_arena();
+}
+
 template<typename T>
 typename Tree<T>::Node& Tree<T>::Node::operator=(typename Tree<T>::Node&& that){
     this->value_ = std::move(that.value_);
@@ -365,10 +473,10 @@ void Tree<T>::Node::rotate(direction_t dir){
             std::swap(A, B);
             new (&C) Node (std::move(B));
             B.~Node();
+            B.bits_ = 0;
             C.reset_child(!dir);
             if(!C.has_any_children()){
-                delete reinterpret_cast<uint8_t*>(C.children_);
-                C.children_ = nullptr;
+                C.release_children();
             }
             A.set_child(dir);
         } else {
@@ -377,6 +485,7 @@ void Tree<T>::Node::rotate(direction_t dir){
             A.set_child(dir);
             A.reset_child(!dir);
             A.children_[!dir].~Node();
+            A.children_[!dir].bits_ = 0;
         }
     }
     Node& E = A.children_[dir];
@@ -453,13 +562,15 @@ typename Tree<T>::reverse_const_iterator_t Tree<T>::crend() const { return rever
 template<typename T>
 template<typename U>
 void Tree<T>::add_priv(U&& X){
-    ++size_;
-    if(size_ == 1){
+    if(size_ == 0){
         root_.value_ = std::forward<U>(X);
+        ++size_;
         return;
     }
+    // size_ only grows once the comparisons in find_spot() went through, a throwing one leaves the tree as it was
     position_t<Node> position = find_spot<Node>(X);
     position.top().first->add_leaf(std::forward<U>(X), position.top().second);
+    ++size_;
     if(position.top().first->balance_factor() == 0){
         return;
     }
@@ -651,11 +762,491 @@ Tree<T>& Tree<T>::operator=(const Tree& that){
 
 template<typename T>
 Tree<T>& Tree<T>::operator=(Tree&& that){
+    this->release_nodes();
     this->root_ = std::move(that.root_);
     this->size_ = that.size_;
     that.size_ = 0;
+    this->compaction_ = std::move(that.compaction_);
     return *this;
 }
+
+// Post-order teardown in O(1) extra memory: while a subtree is being freed, its parent's
+// children_ holds the grandparent instead (pointer reversal). The child being visited is
+// always the lowest one still flagged in the parent's bits_, its pair starts at node - dir.
+template<typename T>
+void Tree<T>::release_nodes(){
+    this->end_compaction();
+    Node* parent = nullptr;
+    Node* node = &this->root_;
+    while(true){
+        if(node->has_any_children()){
+            direction_t dir = !node->has_child(left);
+            Node* child = node->children_ + dir;
+            node->children_ = parent;
+            parent = node;
+            node = child;
+            continue;
+        }
+        if(parent == nullptr) break;
+        direction_t dir = !parent->has_child(left);
+        Node* pair = node - dir;
+        if constexpr(!std::is_trivially_destructible_v<T>){
+            node->value_.~T();
+        }
+        parent->reset_child(dir);
+        if(parent->has_child(right)){
+            node = pair + right;
+            continue;
+        }
+        node = parent;
+        parent = node->children_;
+        node->children_ = pair;
+        node->release_children();
+    }
+}
+
+template<typename T>
+template<direction_t first, typename node_t, typename F>
+void Tree<T>::for_each_priv(F& f) const {
+    if(this->empty()) return;
+    std::array<node_t*, max_height> path;
+    size_t depth = 0;
+    node_t* node = const_cast<node_t*>(&this->root_);
+    while(true){
+        while(node->has_child(first)){
+            if(node->has_child(!first)){
+                GB_PREFETCH(node->children_[!first].children_);
+            }
+            path[depth++] = node;
+            node = node->children_ + first;
+        }
+        f(node->value_);
+        while(!node->has_child(!first)){
+            if(depth == 0) return;
+            node = path[--depth];
+            f(node->value_);
+        }
+        node = node->children_ + !first;
+    }
+}
+
+// height of the subtree, -1 as soon as something is off
+template<typename T>
+int_t Tree<T>::valid_priv(const Node& node, const T*& previous, size_t& count) const {
+    if((node.children_ != nullptr) != node.has_any_children()) return -1;
+    if(node.in_arena() && node.children_ == nullptr) return -1;
+    std::array<int_t, 2> heights{0, 0};
+    if(node.has_child(left)){
+        heights[left] = valid_priv(node.children_[left], previous, count);
+        if(heights[left] < 0) return -1;
+    }
+    if(previous != nullptr && *previous > node.value_) return -1;
+    previous = &node.value_;
+    ++count;
+    if(node.has_child(right)){
+        heights[right] = valid_priv(node.children_[right], previous, count);
+        if(heights[right] < 0) return -1;
+    }
+    if(heights[right] - heights[left] != node.balance_factor()) return -1;
+    if(node.balance_factor() > 1 || node.balance_factor() < -1) return -1;
+    return std::max(heights[left], heights[right]) + 1;
+}
+
+template<typename T>
+bool Tree<T>::valid() const {
+    if(this->empty()) return !this->root_.has_any_children();
+    const T* previous = nullptr;
+    size_t count = 0;
+    return valid_priv(this->root_, previous, count) >= 0 && count == this->size_;
+}
+
+template<typename T>
+void Tree<T>::clear(){
+    this->release_nodes();
+    // release_nodes() already left root_ without children, only its balance bits are stale
+    this->root_.reset_balance_factor();
+    this->size_ = 0;
+}
+
+template<typename T>
+typename Tree<T>::chunk_t* Tree<T>::allocate_chunk(){
+    void* memory = ::operator new(chunk_bytes, std::align_val_t(chunk_bytes));
+    return new (memory) chunk_t{1, nullptr, true};
+}
+
+template<typename T>
+void Tree<T>::release_chunk(chunk_t* chunk){
+    if(--chunk->references == 0){
+        ::operator delete(chunk, chunk_bytes, std::align_val_t(chunk_bytes));
+    }
+}
+
+// dead slots are marked with bits_ == 0 (a live node always has balance bits set), the pass relies on it
+template<typename T>
+void Tree<T>::release_pair(Node* pair){
+    pair[left].bits_ = 0;
+    pair[right].bits_ = 0;
+    release_chunk(chunk_of(pair));
+}
+
+template<typename T>
+void Tree<T>::begin_compaction(){
+    chunk_t* chunk = allocate_chunk();
+    compaction_.reset(new compaction_t{chunk, 0, chunk, 0});
+    if(this->root_.has_any_children()){
+        relocate_children(this->root_);
+    }
+}
+
+template<typename T>
+void Tree<T>::end_compaction(){
+    if(!compaction_) return;
+    for(chunk_t* chunk = compaction_->scan_chunk; chunk != nullptr;){
+        chunk_t* next = chunk->next;
+        chunk->in_pass = false;
+        release_chunk(chunk);
+        chunk = next;
+    }
+    compaction_.reset();
+}
+
+template<typename T>
+void Tree<T>::relocate_children(Node& node){
+    compaction_t& pass = *compaction_;
+    if(pass.fill == chunk_pairs){
+        chunk_t* chunk = allocate_chunk();
+        pass.fill_chunk->next = chunk;
+        pass.fill_chunk = chunk;
+        pass.fill = 0;
+    }
+    Node* pair = pairs_of(pass.fill_chunk) + 2 * pass.fill++;
+    ++pass.fill_chunk->references;
+    for(direction_t dir: {left, right}){
+        if(node.has_child(dir)){
+            new (pair + dir) Node (std::move(node.children_[dir]));
+            node.children_[dir].~Node();
+        } else {
+            pair[dir].bits_ = 0;
+        }
+    }
+    node.release_children();
+    node.children_ = pair;
+    node.set_in_arena();
+}
+
+template<typename T>
+bool Tree<T>::compact_step(size_t budget){
+    if(!compaction_){
+        if(!this->root_.has_any_children()) return true;
+        begin_compaction();
+    }
+    compaction_t& pass = *compaction_;
+    while(!(pass.scan_chunk == pass.fill_chunk && pass.scan == pass.fill)){
+        if(budget == 0) return false;
+        if(pass.scan == chunk_pairs){
+            chunk_t* scanned = pass.scan_chunk;
+            pass.scan_chunk = scanned->next;
+            pass.scan = 0;
+            // every pair in it is scanned, from here on it lives only as long as those pairs do
+            scanned->in_pass = false;
+            release_chunk(scanned);
+            continue;
+        }
+        Node* pair = pairs_of(pass.scan_chunk) + 2 * pass.scan++;
+        --budget;
+        for(direction_t dir: {left, right}){
+            Node& node = pair[dir];
+            if(node.bits_ != 0 && node.has_any_children() && !(node.in_arena() && chunk_of(node.children_)->in_pass)){
+                relocate_children(node);
+            }
+        }
+    }
+    end_compaction();
+    return true;
+}
+
+template<typename T>
+void Tree<T>::compact(){
+    this->end_compaction();
+    this->compact_step(std::numeric_limits<size_t>::max());
+}
+
+    // Fixed-capacity tree kept in a std::array and linked by indices, usable in constant expressions:
+    //     constexpr auto table = []{ AVL::StaticTree<int, 4> t; t.add(3); t.add(1); return t; }();
+    //     static_assert(table.find(3) != nullptr);
+    template<typename T, size_t N>
+    class StaticTree{
+        private:
+            using index_t = uint_t;
+            static constexpr index_t nil = std::numeric_limits<index_t>::max();
+
+            struct Node{
+                T value_{};
+                std::array<index_t, 2> children_{nil, nil};
+                int8_t balance_factor_ = 0;
+            };
+
+            std::array<Node, N> nodes_{};
+            index_t root_ = nil;
+            size_t size_ = 0;
+
+            constexpr index_t rotate(index_t a, direction_t dir);
+            constexpr index_t fix(index_t a);
+        public:
+            class Iterator{
+                private:
+                    friend class StaticTree;
+                    const StaticTree* tree_ = nullptr;
+                    std::array<index_t, max_height> path_{};
+                    size_t depth_ = 0;
+
+                    constexpr void descend(index_t index){
+                        for(; index != nil; index = tree_->nodes_[index].children_[left]){
+                            path_[depth_++] = index;
+                        }
+                    }
+                public:
+                    using iterator_category = std::forward_iterator_tag;
+                    using value_type = T;
+                    using difference_type = std::ptrdiff_t;
+                    using pointer = const T*;
+                    using reference = const T&;
+
+                    constexpr const T& operator*() const { return tree_->nodes_[path_[depth_ - 1]].value_; }
+                    constexpr const T* operator->() const { return &**this; }
+                    constexpr Iterator& operator++(){
+                        index_t current = path_[--depth_];
+                        descend(tree_->nodes_[current].children_[right]);
+                        return *this;
+                    }
+                    constexpr Iterator operator++(int){
+                        Iterator result = *this;
+                        ++(*this);
+                        return result;
+                    }
+                    constexpr bool operator==(const Iterator& that) const {
+                        return this->depth_ == that.depth_ && (depth_ == 0 || path_[depth_ - 1] == that.path_[depth_ - 1]);
+                    }
+                    constexpr bool operator!=(const Iterator& that) const { return !(*this == that); }
+
+                    constexpr Iterator() = default;
+                    constexpr Iterator(const StaticTree* tree): tree_(tree){ descend(tree->root_); }
+            };
+
+            constexpr Iterator begin() const { return Iterator(this); }
+            constexpr Iterator end() const { return Iterator(); }
+
+            constexpr bool empty() const { return size_ == 0; }
+            constexpr size_t size() const { return this->size_; }
+            static constexpr size_t capacity(){ return N; }
+
+            // false once all N slots are taken
+            constexpr bool add(const T& X);
+            constexpr const T* find(const T& X) const;
+
+            constexpr StaticTree() = default;
+            constexpr StaticTree(std::initializer_list<T> list){
+                for(const auto& element : list){
+                    this->add(element);
+                }
+            }
+    };
+
+// same contract as Tree::Node::rotate(): the former top gets .first, the new one .second
+template<typename T, size_t N>
+constexpr typename StaticTree<T, N>::index_t StaticTree<T, N>::rotate(index_t a, direction_t dir){
+    index_t b = nodes_[a].children_[!dir];
+    const ipair& updated_balance_factors = get_updated_balance_factors(nodes_[a].balance_factor_, nodes_[b].balance_factor_);
+    nodes_[a].children_[!dir] = nodes_[b].children_[dir];
+    nodes_[b].children_[dir] = a;
+    nodes_[a].balance_factor_ = static_cast<int8_t>(updated_balance_factors.first);
+    nodes_[b].balance_factor_ = static_cast<int8_t>(updated_balance_factors.second);
+    return b;
+}
+
+template<typename T, size_t N>
+constexpr typename StaticTree<T, N>::index_t StaticTree<T, N>::fix(index_t a){
+    direction_t dir2 = !(nodes_[a].balance_factor_ > 0);
+    index_t child = nodes_[a].children_[!dir2];
+    int_t child_bf = nodes_[child].balance_factor_;
+    direction_t dir1 = child_bf != 0 ? static_cast<direction_t>(child_bf < 0) : dir2;
+    if(dir1 != dir2){
+        nodes_[a].children_[!dir2] = rotate(child, dir1);
+    }
+    return rotate(a, dir2);
+}
+
+template<typename T, size_t N>
+constexpr bool StaticTree<T, N>::add(const T& X){
+    if(size_ == N) return false;
+    index_t added = static_cast<index_t>(size_++);
+    nodes_[added].value_ = X;
+    if(root_ == nil){
+        root_ = added;
+        return true;
+    }
+    std::array<index_t, max_height> path{};
+    std::array<direction_t, max_height> directions{};
+    size_t depth = 0;
+    index_t current = root_;
+    while(current != nil){
+        path[depth] = current;
+        directions[depth] = X > nodes_[current].value_;
+        current = nodes_[current].children_[directions[depth++]];
+    }
+    nodes_[path[depth - 1]].children_[directions[depth - 1]] = added;
+    while(depth != 0){
+        --depth;
+        Node& node = nodes_[path[depth]];
+        node.balance_factor_ += directions[depth] ? 1 : -1;
+        if(node.balance_factor_ == 2 || node.balance_factor_ == -2){
+            index_t top = fix(path[depth]);
+            if(depth == 0) root_ = top;
+            else nodes_[path[depth - 1]].children_[directions[depth - 1]] = top;
+        }
+        if(nodes_[depth == 0 ? root_ : nodes_[path[depth - 1]].children_[directions[depth - 1]]].balance_factor_ == 0){
+            break;
+        }
+    }
+    return true;
+}
+
+template<typename T, size_t N>
+constexpr const T* StaticTree<T, N>::find(const T& X) const {
+    index_t current = root_;
+    while(current != nil){
+        const Node& node = nodes_[current];
+        if(node.value_ == X) return &node.value_;
+        current = node.children_[X > node.value_];
+    }
+    return nullptr;
+}
+
+    // Keeps up to `threshold` elements sorted inline and only switches to a Tree past that.
+    // Falls back to the inline array once the tree shrinks to threshold / 2 elements.
+    template<typename T, size_t threshold = 16>
+    class HybridTree{
+        private:
+            struct inline_t{
+                std::array<T, threshold> elements_{};
+                size_t count_ = 0;
+            };
+            std::variant<inline_t, Tree<T>> storage_;
+
+            inline_t& as_inline(){ return *std::get_if<inline_t>(&storage_); }
+            const inline_t& as_inline() const { return *std::get_if<inline_t>(&storage_); }
+            Tree<T>& as_tree(){ return *std::get_if<Tree<T>>(&storage_); }
+            const Tree<T>& as_tree() const { return *std::get_if<Tree<T>>(&storage_); }
+
+            size_t lower_bound(const T& X) const;
+            void grow();
+            void shrink();
+        public:
+            bool is_inline() const { return storage_.index() == 0; }
+            bool empty() const { return this->size() == 0; }
+            size_t size() const { return this->is_inline() ? this->as_inline().count_ : this->as_tree().size(); }
+
+            void add(const T& X){ this->add_priv(X); }
+            void add(T&& X){ this->add_priv(std::move(X)); }
+            bool remove(const T& X);
+            const T* find(const T& X) const;
+            void clear(){ storage_.template emplace<inline_t>(); }
+
+            template<typename F>
+            void for_each(F&& f) const {
+                if(!this->is_inline()) this->as_tree().for_each(f);
+                else for(size_t i = 0; i < this->as_inline().count_; ++i) f(this->as_inline().elements_[i]);
+            }
+            template<typename F>
+            void for_each_reverse(F&& f) const {
+                if(!this->is_inline()) this->as_tree().for_each_reverse(f);
+                else for(size_t i = this->as_inline().count_; i != 0; --i) f(this->as_inline().elements_[i - 1]);
+            }
+
+            HybridTree() = default;
+            HybridTree(std::initializer_list<T> list){
+                for(auto& element : list){
+                    this->add(element);
+                }
+            }
+        private:
+            template<typename U>
+            void add_priv(U&& X);
+    };
+
+// branchless: the loop only depends on count_, the comparison result just moves `base`
+template<typename T, size_t threshold>
+size_t HybridTree<T, threshold>::lower_bound(const T& X) const {
+    const inline_t& sorted = this->as_inline();
+    size_t base = 0;
+    size_t length = sorted.count_;
+    while(length > 1){
+        size_t half = length >> 1;
+        base += static_cast<size_t>(X > sorted.elements_[base + half - 1]) * half;
+        length -= half;
+    }
+    return base + static_cast<size_t>(length == 1 && X > sorted.elements_[base]);
+}
+
+template<typename T, size_t threshold>
+void HybridTree<T, threshold>::grow(){
+    Tree<T> tree;
+    for(T& element: this->as_inline().elements_){
+        tree.add(std::move(element));
+    }
+    storage_.template emplace<Tree<T>>(std::move(tree));
+}
+
+template<typename T, size_t threshold>
+void HybridTree<T, threshold>::shrink(){
+    Tree<T> tree(std::move(this->as_tree()));
+    inline_t& sorted = storage_.template emplace<inline_t>();
+    // the tree is dropped right after, so its values can be moved out
+    tree.drain([&sorted](T& value){ sorted.elements_[sorted.count_++] = std::move(value); });
+}
+
+template<typename T, size_t threshold>
+template<typename U>
+void HybridTree<T, threshold>::add_priv(U&& X){
+    if(this->is_inline() && this->as_inline().count_ == threshold){
+        this->grow();
+    }
+    if(!this->is_inline()){
+        this->as_tree().add(std::forward<U>(X));
+        return;
+    }
+    inline_t& sorted = this->as_inline();
+    size_t spot = this->lower_bound(X);
+    std::move_backward(sorted.elements_.begin() + spot, sorted.elements_.begin() + sorted.count_, sorted.elements_.begin() + sorted.count_ + 1);
+    sorted.elements_[spot] = std::forward<U>(X);
+    ++sorted.count_;
+}
+
+template<typename T, size_t threshold>
+bool HybridTree<T, threshold>::remove(const T& X){
+    if(!this->is_inline()){
+        if(!this->as_tree().remove(X)) return false;
+        if(this->as_tree().size() <= threshold / 2) this->shrink();
+        return true;
+    }
+    inline_t& sorted = this->as_inline();
+    size_t spot = this->lower_bound(X);
+    if(spot == sorted.count_ || sorted.elements_[spot] != X) return false;
+    std::move(sorted.elements_.begin() + spot + 1, sorted.elements_.begin() + sorted.count_, sorted.elements_.begin() + spot);
+    --sorted.count_;
+    return true;
+}
+
+template<typename T, size_t threshold>
+const T* HybridTree<T, threshold>::find(const T& X) const {
+    if(!this->is_inline()){
+        auto position = this->as_tree().find(X);
+        return position.top().first ? &position.top().first->value() : nullptr;
+    }
+    const inline_t& sorted = this->as_inline();
+    size_t spot = this->lower_bound(X);
+    return spot != sorted.count_ && sorted.elements_[spot] == X ? &sorted.elements_[spot] : nullptr;
+}
 }
 
 #endif
\ No newline at end of file
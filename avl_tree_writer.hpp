@@ -0,0 +1,194 @@
+#ifndef GB_AVL_TREE_WRITER
+#define GB_AVL_TREE_WRITER
+
+#include <avl_tree.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace AVL{
+    // Single-writer front-end for a Tree shared between threads.
+    // add()/remove() only push onto a lock-free queue and hand back a Future; one applier thread
+    // drains the queue and applies every batch sorted by value under a single exclusive lock.
+    // This is a reader/writer lock, not snapshot publication: read() takes the shared side and waits
+    // while a batch is being applied. epoch() counts applied batches, so a reader can tell whether
+    // anything changed since an earlier read().
+    template<typename T>
+    class TreeWriter{
+        private:
+            enum class operation_t: uint_t{
+                add = 0,
+                remove = 1,
+            };
+
+            // the only allocation of an operation, shared by its Future and the applier
+            struct Request{
+                T value_;
+                operation_t operation_;
+                Request* next_;
+                std::atomic<uint_t> references_;
+                std::atomic<bool> done_;
+                bool result_;
+                std::exception_ptr error_;
+
+                template<typename U>
+                Request(U&& value, operation_t operation): value_(std::forward<U>(value)), operation_(operation), next_(nullptr),
+                                                           references_(2), done_(false), result_(false){}
+            };
+        public:
+            class Future{
+                private:
+                    friend class TreeWriter;
+                    TreeWriter* writer_;
+                    Request* request_;
+                    Future(TreeWriter* writer, Request* request): writer_(writer), request_(request){}
+                public:
+                    bool ready() const { return this->request_->done_.load(std::memory_order_acquire); }
+                    void wait() const {
+                        if(this->ready()) return;
+                        std::unique_lock<std::mutex> lock(writer_->done_mutex_);
+                        writer_->done_.wait(lock, [this]{ return this->ready(); });
+                    }
+                    // add() always yields true, remove() Tree::remove()'s result; rethrows what the tree threw
+                    bool get() const {
+                        this->wait();
+                        if(request_->error_) std::rethrow_exception(request_->error_);
+                        return request_->result_;
+                    }
+
+                    Future(const Future&) = delete;
+                    Future& operator=(const Future&) = delete;
+                    Future(Future&& that): writer_(that.writer_), request_(that.request_){ that.request_ = nullptr; }
+                    Future& operator=(Future&& that){
+                        std::swap(this->writer_, that.writer_);
+                        std::swap(this->request_, that.request_);
+                        return *this;
+                    }
+                    ~Future(){
+                        if(request_ != nullptr) release(request_);
+                    }
+            };
+        private:
+            Tree<T> tree_;
+            mutable std::shared_mutex tree_mutex_;
+            std::atomic<Request*> pending_;
+            std::atomic<uint64_t> epoch_;
+            std::atomic<bool> sleeping_;
+            std::atomic<bool> stopping_;
+            std::mutex wake_mutex_;
+            std::condition_variable wake_;
+            std::mutex done_mutex_;
+            std::condition_variable done_;
+            std::thread applier_;
+
+            static void release(Request* request){
+                if(request->references_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete request;
+            }
+            Future submit(Request* request);
+            void apply_loop();
+            void apply(std::vector<Request*>& batch);
+        public:
+            Future add(const T& X){ return submit(new Request(X, operation_t::add)); }
+            Future add(T&& X){ return submit(new Request(std::move(X), operation_t::add)); }
+            Future remove(const T& X){ return submit(new Request(X, operation_t::remove)); }
+
+            template<typename F>
+            auto read(F&& f) const {
+                std::shared_lock<std::shared_mutex> lock(tree_mutex_);
+                return f(static_cast<const Tree<T>&>(tree_));
+            }
+            uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+            TreeWriter(): pending_(nullptr), epoch_(0), sleeping_(false), stopping_(false),
+                          applier_(&TreeWriter::apply_loop, this){}
+            TreeWriter(const TreeWriter&) = delete;
+            TreeWriter& operator=(const TreeWriter&) = delete;
+            ~TreeWriter(){
+                {
+                    std::lock_guard<std::mutex> lock(wake_mutex_);
+                    stopping_ = true;
+                }
+                wake_.notify_one();
+                applier_.join();
+            }
+    };
+
+template<typename T>
+typename TreeWriter<T>::Future TreeWriter<T>::submit(Request* request){
+    request->next_ = pending_.load(std::memory_order_relaxed);
+    while(!pending_.compare_exchange_weak(request->next_, request)){}
+    if(sleeping_.load()){
+        // taking the lock keeps the notification from slipping in before the applier waits
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_.notify_one();
+    return Future(this, request);
+}
+
+template<typename T>
+void TreeWriter<T>::apply_loop(){
+    std::vector<Request*> batch;
+    std::vector<Request*> sorted;
+    while(true){
+        Request* head = pending_.exchange(nullptr);
+        if(head == nullptr){
+            if(stopping_) return;
+            sleeping_ = true;
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait(lock, [this]{ return pending_.load() != nullptr || stopping_; });
+            sleeping_ = false;
+            continue;
+        }
+        for(; head != nullptr; head = head->next_){
+            batch.push_back(head);
+        }
+        // the queue is LIFO, restore arrival order so requests on equal values keep it
+        std::reverse(batch.begin(), batch.end());
+        sorted.assign(batch.begin(), batch.end());
+        std::vector<Request*>* order = &sorted;
+        try{
+            std::stable_sort(sorted.begin(), sorted.end(), [](const Request* a, const Request* b){ return b->value_ > a->value_; });
+        } catch(...){
+            // a throwing comparison only costs the ordering, the failing requests report it in apply()
+            order = &batch;
+        }
+        this->apply(*order);
+        batch.clear();
+    }
+}
+
+template<typename T>
+void TreeWriter<T>::apply(std::vector<Request*>& batch){
+    {
+        std::unique_lock<std::shared_mutex> lock(tree_mutex_);
+        for(Request* request: batch){
+            try{
+                if(request->operation_ == operation_t::add){
+                    tree_.add(std::move(request->value_));
+                    request->result_ = true;
+                } else {
+                    request->result_ = tree_.remove(request->value_);
+                }
+            } catch(...){
+                request->error_ = std::current_exception();
+            }
+        }
+        epoch_.fetch_add(1, std::memory_order_release);
+    }
+    {
+        std::lock_guard<std::mutex> lock(done_mutex_);
+        for(Request* request: batch){
+            request->done_.store(true, std::memory_order_release);
+        }
+    }
+    done_.notify_all();
+    for(Request* request: batch){
+        release(request);
+    }
+}
+}
+
+#endif
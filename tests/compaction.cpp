@@ -0,0 +1,109 @@
+// compact()/compact_step() interleaved with writes, checked against std::multiset.
+// Chunk memory is counted through the aligned operator new, which only compaction chunks use.
+#include <avl_tree.hpp>
+#include <cstdlib>
+#include <set>
+#include <random>
+
+static size_t chunk_bytes_in_use = 0;
+
+void* operator new(size_t size, std::align_val_t alignment){
+    void* memory = std::aligned_alloc(static_cast<size_t>(alignment), size);
+    if(memory == nullptr) throw std::bad_alloc();
+    chunk_bytes_in_use += size;
+    return memory;
+}
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+void operator delete(void* memory, size_t size, std::align_val_t) noexcept {
+    chunk_bytes_in_use -= size;
+    std::free(memory);
+}
+
+bool same(const AVL::Tree<int>& tree, const std::multiset<int>& reference){
+    if(!tree.valid() || tree.size() != reference.size()) return false;
+    auto expected = reference.begin();
+    bool equal = true;
+    tree.for_each([&](const int& element){ equal = equal && expected != reference.end() && *expected++ == element; });
+    return equal && expected == reference.end();
+}
+
+// small trees, random writes between budgeted steps and the occasional full compact()
+bool interleaved(uint32_t seed){
+    std::mt19937 rng(seed);
+    AVL::Tree<int> tree;
+    std::multiset<int> reference;
+    for(size_t step = 0; step < 10000; ++step){
+        int value = static_cast<int>(rng() % 512);
+        switch(rng() % 6){
+            case 0: case 1:
+                tree.add(value);
+                reference.insert(value);
+                break;
+            case 2: case 3: {
+                auto found = reference.find(value);
+                if(tree.remove(value) != (found != reference.end())) return false;
+                if(found != reference.end()) reference.erase(found);
+                break;
+            }
+            case 4:
+                tree.compact_step(rng() % 16);
+                break;
+            case 5:
+                if(rng() % 64 == 0) tree.compact();
+                break;
+        }
+        if(!same(tree, reference)) return false;
+    }
+    return true;
+}
+
+// churn on a large tree must not pile up chunks, and the pass must still finish
+bool churn(){
+    AVL::Tree<int> tree;
+    std::multiset<int> reference;
+    std::mt19937 rng(7);
+    for(int i = 0; i < 100000; ++i){
+        int value = static_cast<int>(rng());
+        tree.add(value);
+        reference.insert(value);
+    }
+    tree.compact();
+    size_t settled = chunk_bytes_in_use;
+    for(int round = 0; round < 2000; ++round){
+        tree.compact_step(1000);
+        int value = static_cast<int>(rng());
+        tree.add(value);
+        reference.insert(value);
+        auto victim = reference.begin();
+        std::advance(victim, rng() % 64);
+        if(!tree.remove(*victim)) return false;
+        reference.erase(victim);
+        if(chunk_bytes_in_use > 3 * settled) return false;
+    }
+    size_t steps = 0;
+    while(!tree.compact_step(1000)){
+        if(++steps > 1000) return false;
+    }
+    tree.compact();
+    if(chunk_bytes_in_use > settled + settled / 8) return false;
+    if(!same(tree, reference)) return false;
+    tree.clear();
+    return chunk_bytes_in_use == 0;
+}
+
+int main(){
+    for(uint32_t seed = 0; seed < 8; ++seed){
+        if(!interleaved(seed)){
+            std::cout << "FAILED: interleaved, seed " << seed << "\n";
+            return 1;
+        }
+    }
+    if(!churn()){
+        std::cout << "FAILED: churn, " << chunk_bytes_in_use << " chunk bytes in use\n";
+        return 1;
+    }
+    std::cout << "OK\n";
+    return 0;
+}
@@ -0,0 +1,76 @@
+#ifndef GB_AVL_TREE_DIFFERENTIAL
+#define GB_AVL_TREE_DIFFERENTIAL
+
+// One randomized step applied to both AVL::Tree and std::multiset, shared by stress.cpp and fuzz.cpp.
+// Every step ends with tree.valid() and a size comparison.
+#include <avl_tree.hpp>
+#include <set>
+#include <vector>
+#include <algorithm>
+
+// cbegin()/cend() must visit exactly the reference values.
+// Known defect inherited from the baseline: the iterators walk the tree in pre-order where they
+// should be in-order. The pre-order check below pins down today's behaviour so the walk can't
+// silently skip or repeat nodes; it is not the iterators' contract and goes once they are fixed.
+inline bool same_pre_order(const AVL::Tree<int>& tree, const std::multiset<int>& reference){
+    std::vector<int> values;
+    if(!tree.empty()){
+        for(auto i = tree.cbegin(); i != tree.cend(); ++i){
+            values.push_back(*i);
+        }
+    }
+    if(values.size() != reference.size()) return false;
+    // baseline defect, see above
+    std::vector<int> ancestors;
+    bool bounded = false;
+    int lower = 0;
+    for(int value: values){
+        if(bounded && value < lower) return false;
+        while(!ancestors.empty() && ancestors.back() < value){
+            lower = ancestors.back();
+            bounded = true;
+            ancestors.pop_back();
+        }
+        ancestors.push_back(value);
+    }
+    std::sort(values.begin(), values.end());
+    return std::equal(values.begin(), values.end(), reference.begin());
+}
+
+inline bool apply_operation(AVL::Tree<int>& tree, std::multiset<int>& reference, uint8_t operation, int value){
+    switch(operation % 10){
+        case 0: case 1: case 2:
+            tree.add(value);
+            reference.insert(value);
+            break;
+        case 3: case 4: case 5: {
+            auto found = reference.find(value);
+            if(tree.remove(value) != (found != reference.end())) return false;
+            if(found != reference.end()) reference.erase(found);
+            break;
+        }
+        case 6: {
+            bool same = true;
+            auto expected = reference.begin();
+            tree.for_each([&](const int& element){ same = same && expected != reference.end() && *expected++ == element; });
+            if(!same || expected != reference.end()) return false;
+            auto expected_reverse = reference.rbegin();
+            tree.for_each_reverse([&](const int& element){ same = same && expected_reverse != reference.rend() && *expected_reverse++ == element; });
+            if(!same || expected_reverse != reference.rend()) return false;
+            break;
+        }
+        case 7:
+            if(!same_pre_order(tree, reference)) return false;
+            break;
+        case 8:
+            tree.compact_step(static_cast<size_t>(value) & 31);
+            break;
+        case 9:
+            if(operation < 40) tree.compact();
+            else tree.compact_step(1);
+            break;
+    }
+    return tree.valid() && tree.size() == reference.size();
+}
+
+#endif
@@ -0,0 +1,12 @@
+// libFuzzer entry point: every byte pair of the input is one differential step (operation, value).
+#include "differential.hpp"
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size){
+    AVL::Tree<int> tree;
+    std::multiset<int> reference;
+    for(size_t i = 0; i + 1 < size; i += 2){
+        if(!apply_operation(tree, reference, data[i], static_cast<int8_t>(data[i + 1]))) abort();
+    }
+    return 0;
+}
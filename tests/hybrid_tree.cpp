@@ -0,0 +1,82 @@
+// HybridTree: switching between the inline array and the tree, checked against std::multiset.
+#include <avl_tree.hpp>
+#include <set>
+#include <random>
+#include <vector>
+
+// counts copies, growing and shrinking should only ever move values
+struct Tracked{
+    static size_t copies;
+    int value = 0;
+    Tracked() = default;
+    Tracked(int v): value(v){}
+    Tracked(const Tracked& that): value(that.value){ ++copies; }
+    Tracked(Tracked&&) = default;
+    Tracked& operator=(const Tracked& that){ value = that.value; ++copies; return *this; }
+    Tracked& operator=(Tracked&&) = default;
+    bool operator>(const Tracked& that) const { return value > that.value; }
+    bool operator==(const Tracked& that) const { return value == that.value; }
+    bool operator!=(const Tracked& that) const { return value != that.value; }
+};
+size_t Tracked::copies = 0;
+
+template<size_t threshold>
+bool differential(uint32_t seed){
+    std::mt19937 rng(seed);
+    for(int round = 0; round < 200; ++round){
+        AVL::HybridTree<Tracked, threshold> tree;
+        std::multiset<int> reference;
+        int count = static_cast<int>(rng() % 120);
+        for(int i = 0; i < 4 * count; ++i){
+            int value = static_cast<int>(rng() % 40);
+            if(rng() % 2){
+                tree.add(Tracked(value));
+                reference.insert(value);
+            } else {
+                auto found = reference.find(value);
+                if(tree.remove(Tracked(value)) != (found != reference.end())) return false;
+                if(found != reference.end()) reference.erase(found);
+            }
+            const Tracked* found = tree.find(Tracked(value));
+            if(tree.size() != reference.size() || (found != nullptr) != (reference.count(value) != 0)) return false;
+            if(tree.size() <= threshold / 2 && !tree.is_inline()) return false;
+            if(tree.size() > threshold && tree.is_inline()) return false;
+        }
+        std::vector<int> forward, backward;
+        tree.for_each([&](const Tracked& element){ forward.push_back(element.value); });
+        tree.for_each_reverse([&](const Tracked& element){ backward.push_back(element.value); });
+        if(forward != std::vector<int>(reference.begin(), reference.end())) return false;
+        if(backward != std::vector<int>(reference.rbegin(), reference.rend())) return false;
+    }
+    return true;
+}
+
+// grows past the threshold, then shrinks back into the array
+bool round_trip(){
+    AVL::HybridTree<Tracked, 16> tree;
+    for(int i = 0; i < 40; ++i) tree.add(Tracked(i));
+    if(tree.is_inline()) return false;
+    for(int i = 0; i < 32; ++i) tree.remove(Tracked(i));
+    if(!tree.is_inline() || tree.size() != 8) return false;
+    int expected = 32;
+    bool same = true;
+    tree.for_each([&](const Tracked& element){ same = same && element.value == expected++; });
+    return same && expected == 40;
+}
+
+int main(){
+    if(!round_trip()){
+        std::cout << "FAILED: round trip\n";
+        return 1;
+    }
+    if(!differential<16>(1) || !differential<4>(2) || !differential<1>(3) || !differential<7>(4)){
+        std::cout << "FAILED: differential\n";
+        return 1;
+    }
+    if(Tracked::copies != 0){
+        std::cout << "FAILED: " << Tracked::copies << " copies\n";
+        return 1;
+    }
+    std::cout << "OK\n";
+    return 0;
+}
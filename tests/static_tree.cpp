@@ -0,0 +1,57 @@
+// StaticTree: construction, lookup and iteration in constant expressions, plus a runtime check against std::multiset.
+#include <avl_tree.hpp>
+#include <set>
+#include <random>
+#include <vector>
+
+constexpr auto opcodes = []{
+    AVL::StaticTree<int, 64> tree;
+    for(int i = 0; i < 64; ++i) tree.add((i * 37) % 64);
+    return tree;
+}();
+static_assert(opcodes.size() == 64);
+static_assert(opcodes.find(17) != nullptr && *opcodes.find(17) == 17);
+static_assert(opcodes.find(99) == nullptr);
+
+constexpr bool ascending(){
+    int previous = -1;
+    int count = 0;
+    for(auto i = opcodes.begin(); i != opcodes.end(); i++){
+        if(*i <= previous) return false;
+        previous = *i;
+        ++count;
+    }
+    return count == 64;
+}
+static_assert(ascending());
+static_assert(*AVL::StaticTree<int, 3>{3, 1, 2}.begin() == 1);
+static_assert(!AVL::StaticTree<int, 1>{}.find(0));
+
+int main(){
+    std::mt19937 rng(5);
+    for(int round = 0; round < 1000; ++round){
+        AVL::StaticTree<int, 200> tree;
+        std::multiset<int> reference;
+        int count = static_cast<int>(rng() % 210);
+        for(int i = 0; i < count; ++i){
+            int value = static_cast<int>(rng() % 50);
+            bool added = tree.add(value);
+            if(added != (i < 200)){
+                std::cout << "FAILED: capacity, round " << round << "\n";
+                return 1;
+            }
+            if(added) reference.insert(value);
+        }
+        std::vector<int> values(tree.begin(), tree.end());
+        bool found = true;
+        for(int value = 0; value < 50; ++value){
+            found = found && (tree.find(value) != nullptr) == (reference.count(value) != 0);
+        }
+        if(values != std::vector<int>(reference.begin(), reference.end()) || !found){
+            std::cout << "FAILED: round " << round << "\n";
+            return 1;
+        }
+    }
+    std::cout << "OK\n";
+    return 0;
+}
@@ -0,0 +1,28 @@
+// Randomized differential test against std::multiset, meant to run under -fsanitize=address,undefined.
+#include "differential.hpp"
+#include <random>
+
+bool stress_test(uint32_t seed, size_t operations){
+    std::mt19937 rng(seed);
+    AVL::Tree<int> tree;
+    std::multiset<int> reference;
+    for(size_t step = 0; step < operations; ++step){
+        if(rng() % 1024 == 0){
+            tree.clear();
+            reference.clear();
+        }
+        if(!apply_operation(tree, reference, static_cast<uint8_t>(rng()), static_cast<int>(rng() % 1024) - 512)){
+            std::cout << "MISMATCH: seed " << seed << ", step " << step << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(){
+    for(uint32_t seed = 0; seed < 16; ++seed){
+        if(!stress_test(seed, 100000)) return 1;
+    }
+    std::cout << "OK\n";
+    return 0;
+}
@@ -0,0 +1,84 @@
+// TreeWriter: concurrent producers and readers, results checked against the sequential outcome.
+#include <avl_tree_writer.hpp>
+#include <set>
+#include <stdexcept>
+
+// comparisons involving 13 throw, to check that the applier hands exceptions to the Futures
+struct Key{
+    int value;
+    bool operator>(const Key& that) const {
+        if(value == 13 || that.value == 13) throw std::runtime_error("13");
+        return value > that.value;
+    }
+    bool operator==(const Key& that) const { return value == that.value; }
+    bool operator!=(const Key& that) const { return value != that.value; }
+};
+
+bool producers(){
+    constexpr int threads = 8;
+    constexpr int operations = 20000;
+    std::atomic<bool> failed(false);
+    AVL::TreeWriter<int> writer;
+    std::vector<std::thread> workers;
+    for(int k = 0; k < threads; ++k){
+        workers.emplace_back([&, k]{
+            std::vector<AVL::TreeWriter<int>::Future> futures;
+            for(int i = 0; i < operations; ++i){
+                futures.push_back(writer.add(k * operations + i));
+                if(i % 3 == 0) futures.push_back(writer.remove(k * operations + i));
+            }
+            for(auto& future: futures){
+                if(!future.get()) failed = true;
+            }
+        });
+    }
+    std::thread reader([&]{
+        uint64_t epoch = 0;
+        for(int i = 0; i < 500; ++i){
+            bool valid = writer.read([](const AVL::Tree<int>& tree){ return tree.valid(); });
+            if(!valid || writer.epoch() < epoch) failed = true;
+            epoch = writer.epoch();
+        }
+    });
+    for(auto& worker: workers) worker.join();
+    reader.join();
+    std::multiset<int> expected;
+    for(int k = 0; k < threads; ++k){
+        for(int i = 0; i < operations; ++i){
+            if(i % 3 != 0) expected.insert(k * operations + i);
+        }
+    }
+    bool same = writer.read([&](const AVL::Tree<int>& tree){
+        auto next = expected.begin();
+        bool equal = tree.size() == expected.size();
+        tree.for_each([&](const int& element){ equal = equal && next != expected.end() && *next++ == element; });
+        return equal;
+    });
+    return same && !failed;
+}
+
+bool exceptions(){
+    AVL::TreeWriter<Key> writer;
+    writer.add(Key{1}).get();
+    auto thrown = writer.add(Key{13});
+    auto fine = writer.add(Key{2});
+    try{
+        thrown.get();
+        return false;
+    } catch(const std::runtime_error&){}
+    auto removed = writer.remove(Key{2});
+    return fine.get() && removed.get() && writer.read([](const AVL::Tree<Key>& tree){ return tree.valid() && tree.size() == 1; });
+}
+
+int main(){
+    if(!producers()){
+        std::cout << "FAILED: producers\n";
+        return 1;
+    }
+    if(!exceptions()){
+        std::cout << "FAILED: exceptions\n";
+        return 1;
+    }
+    std::cout << "OK\n";
+    return 0;
+}